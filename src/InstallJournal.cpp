@@ -0,0 +1,133 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+
+#include <unistd.h>
+
+#include "InstallJournal.h"
+
+InstallJournal::InstallJournal(const QString &path)
+    : m_path(path) {}
+
+bool InstallJournal::load() {
+
+    m_state = JournalState();
+
+    QFile file(m_path);
+    if (!file.exists())
+        return true;
+
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QByteArray data = file.readAll();
+    file.close();
+
+    // Последняя строка без разделителя - запись, оборванная на середине
+    const int lastComplete = data.lastIndexOf(RECORD_SEP);
+    if (lastComplete < 0)
+        return true;
+
+    const QList<QByteArray> records = data.left(lastComplete).split(RECORD_SEP);
+    for (const auto &record : records) {
+        if (!record.isEmpty())
+            replay(record.split(FIELD_SEP));
+    }
+
+    return true;
+}
+
+void InstallJournal::replay(const QList<QByteArray> &fields) {
+
+    const QByteArray &tag = fields[0];
+
+    if (tag == TAG_BEGIN && fields.size() == 3) {
+        m_state = JournalState();
+        m_state.appVersion = QString::fromUtf8(fields[1]);
+        m_state.packageName = QString::fromUtf8(fields[2]);
+    } else if (tag == TAG_EXTRACTED && fields.size() == 3) {
+        m_state.extractedFiles[QString::fromUtf8(fields[1])] =
+                                            QByteArray::fromHex(fields[2]);
+    } else if (tag == TAG_DPKG_STARTED) {
+        m_state.dpkgStarted = true;
+    } else if (tag == TAG_CONFIGURED && fields.size() == 2) {
+        m_state.configuredPackages.insert(QString::fromUtf8(fields[1]));
+    } else if (tag == TAG_FINISHED) {
+        m_state.finished = true;
+    }
+}
+
+bool InstallJournal::beginJob(const QString &appVersion,
+                              const QString &packageName) {
+
+    // Новое задание начинает журнал заново, история прошлых не нужна
+    if (!append({TAG_BEGIN, appVersion, packageName}, true))
+        return false;
+
+    m_state = JournalState();
+    m_state.appVersion = appVersion;
+    m_state.packageName = packageName;
+    return true;
+}
+
+bool InstallJournal::recordExtracted(const QString &filename,
+                                     const QByteArray &sha256) {
+
+    if (!append({TAG_EXTRACTED, filename, QString::fromLatin1(sha256.toHex())}))
+        return false;
+
+    m_state.extractedFiles[filename] = sha256;
+    return true;
+}
+
+bool InstallJournal::recordDpkgStarted() {
+
+    if (m_state.dpkgStarted)
+        return true;
+
+    if (!append({TAG_DPKG_STARTED}))
+        return false;
+
+    m_state.dpkgStarted = true;
+    return true;
+}
+
+bool InstallJournal::recordConfigured(const QString &debPackage) {
+
+    if (m_state.configuredPackages.contains(debPackage))
+        return true;
+
+    if (!append({TAG_CONFIGURED, debPackage}))
+        return false;
+
+    m_state.configuredPackages.insert(debPackage);
+    return true;
+}
+
+bool InstallJournal::recordFinished() {
+
+    if (!append({TAG_FINISHED}))
+        return false;
+
+    m_state.finished = true;
+    return true;
+}
+
+bool InstallJournal::append(const QStringList &fields, bool truncate) {
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+
+    QFile file(m_path);
+    const QIODevice::OpenMode mode = truncate ? QIODevice::Truncate
+                                              : QIODevice::Append;
+    if (!file.open(QIODevice::WriteOnly | mode))
+        return false;
+
+    QByteArray record = fields.join(QChar(FIELD_SEP)).toUtf8();
+    record.append(RECORD_SEP);
+
+    if (file.write(record) != record.size() || !file.flush())
+        return false;
+
+    return ::fsync(file.handle()) == 0;
+}
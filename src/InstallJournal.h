@@ -0,0 +1,57 @@
+#ifndef INSTALLJOURNAL_H
+#define INSTALLJOURNAL_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QMap>
+#include <QSet>
+
+// Состояние задания установки, восстановленное из журнала
+struct JournalState {
+    QString appVersion;
+    QString packageName;
+    QMap<QString, QByteArray> extractedFiles;
+    QSet<QString> configuredPackages;
+    bool dpkgStarted = false;
+    bool finished = false;
+
+    bool isPending() const { return !packageName.isEmpty() && !finished; }
+};
+
+// Журнал установки: только дозапись, одна строка на завершённый этап.
+// Каждая запись сбрасывается на диск, поэтому после обрыва питания
+// теряется не больше одной (недописанной) строки.
+class InstallJournal {
+
+    static constexpr const char *TAG_BEGIN = "BEGIN";
+    static constexpr const char *TAG_EXTRACTED = "EXTRACTED";
+    static constexpr const char *TAG_DPKG_STARTED = "DPKG_STARTED";
+    static constexpr const char *TAG_CONFIGURED = "CONFIGURED";
+    static constexpr const char *TAG_FINISHED = "FINISHED";
+
+    static constexpr char FIELD_SEP = '\t';
+    static constexpr char RECORD_SEP = '\n';
+
+public:
+    explicit InstallJournal(const QString &path);
+
+    const JournalState &state() const { return m_state; }
+
+    bool load();
+
+    bool beginJob(const QString &appVersion, const QString &packageName);
+    bool recordExtracted(const QString &filename, const QByteArray &sha256);
+    bool recordDpkgStarted();
+    bool recordConfigured(const QString &debPackage);
+    bool recordFinished();
+
+private:
+    QString m_path;
+    JournalState m_state;
+
+    bool append(const QStringList &fields, bool truncate = false);
+    void replay(const QList<QByteArray> &fields);
+};
+
+#endif // INSTALLJOURNAL_H
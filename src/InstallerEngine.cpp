@@ -4,14 +4,29 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QDirIterator>
+#include <QStandardPaths>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QtConcurrent>
+#include <QUrl>
 
 #include "InstallerEngine.h"
 #include "SystemCommand.h"
 
 InstallerEngine::InstallerEngine(QObject *parent)
     : QObject(parent)
+    , m_catalogWatcher(nullptr)
+    , m_catalogLoaded(false)
     , m_process(new QProcess(this))
-    , m_tempDir(new QTemporaryDir()) {
+    , m_statusProcess(new QProcess(this))
+    , m_workDir(QStandardPaths::writableLocation(
+                    QStandardPaths::AppLocalDataLocation) + "/work")
+    , m_journal(QStandardPaths::writableLocation(
+                    QStandardPaths::AppLocalDataLocation) + "/install.journal")
+    , m_stage(Stage::Idle)
+    , m_configureDone(false)
+    , m_statusChecked(false)
+    , m_needsConfigure(false) {
 
     connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
                                     this, &InstallerEngine::onProcessFinished);
@@ -21,15 +36,57 @@ InstallerEngine::InstallerEngine(QObject *parent)
                                     this, &InstallerEngine::readProcessOutput);
     connect(m_process, &QProcess::readyReadStandardError,
                                     this, &InstallerEngine::readProcessOutput);
-}
 
-InstallerEngine::~InstallerEngine() {
-    delete m_tempDir;
+    connect(m_statusProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                                    this, &InstallerEngine::onStatusQueryFinished);
+    connect(m_statusProcess, &QProcess::errorOccurred,
+                                    this, [this](QProcess::ProcessError error) {
+        // finished не придёт, если dpkg-query не запустился
+        if (error == QProcess::FailedToStart)
+            onStatusQueryFinished(-1);
+    });
 }
 
+InstallerEngine::~InstallerEngine() {}
+
 bool InstallerEngine::loadPackages() {
 
-    m_packages.clear();
+    m_packages = scanCatalog();
+    m_journal.load();
+    m_catalogLoaded = true;
+
+    return !m_packages.isEmpty();
+}
+
+void InstallerEngine::loadPackagesAsync() {
+
+    if (m_catalogWatcher != nullptr)
+        return;
+
+    // Чтение .list из ресурсов не трогает состояние движка и идёт в пуле
+    // потоков; журнал и каталог присваиваются уже в основном потоке
+    m_catalogWatcher = new QFutureWatcher<PackageCatalog>(this);
+    connect(m_catalogWatcher, &QFutureWatcher<PackageCatalog>::finished,
+                                    this, &InstallerEngine::onCatalogLoaded);
+    m_catalogWatcher->setFuture(QtConcurrent::run(&InstallerEngine::scanCatalog));
+}
+
+void InstallerEngine::onCatalogLoaded() {
+
+    m_packages = m_catalogWatcher->result();
+    m_journal.load();
+    m_catalogLoaded = true;
+
+    emit packagesLoaded(!m_packages.isEmpty());
+}
+
+bool InstallerEngine::isCatalogLoaded() const {
+    return m_catalogLoaded;
+}
+
+PackageCatalog InstallerEngine::scanCatalog() {
+
+    PackageCatalog packages;
 
     QStringList listFiles;
     QDirIterator it(":/packages", QStringList() << "*.list",
@@ -52,18 +109,15 @@ bool InstallerEngine::loadPackages() {
         }
     }
 
-    if (listFiles.isEmpty())
-        return false;
-
     for (const auto &listFilePath : qAsConst(listFiles)) {
 
         PackageInfo packageInfo = readPackageInfo(listFilePath);
 
         if (!packageInfo.displayName.isEmpty() && !packageInfo.debFiles.isEmpty())
-            m_packages[packageInfo.displayName] = packageInfo.debFiles;
+            packages[packageInfo.displayName] = packageInfo.debFiles;
     }
 
-    return !m_packages.isEmpty();
+    return packages;
 }
 
 PackageInfo InstallerEngine::readPackageInfo(const QString &resourcePath) {
@@ -105,6 +159,41 @@ QStringList InstallerEngine::getAvailablePackages() const {
     return m_packages.keys();
 }
 
+QStringList InstallerEngine::getPackageFiles() const {
+
+    QStringList resourcePaths;
+    for (const QStringList &debFiles : m_packages) {
+        for (const QString &debFile : debFiles)
+            resourcePaths.append(":/packages/" + debFile);
+    }
+
+    // Один .deb может входить в несколько .list
+    resourcePaths.removeDuplicates();
+    return resourcePaths;
+}
+
+bool InstallerEngine::hasPendingJob() const {
+
+    const JournalState &state = m_journal.state();
+
+    return state.isPending() && m_packages.contains(state.packageName) &&
+           state.appVersion == QCoreApplication::applicationVersion();
+}
+
+QString InstallerEngine::getPendingPackage() const {
+    return hasPendingJob() ? m_journal.state().packageName : QString();
+}
+
+bool InstallerEngine::discardPendingJob() {
+
+    // Задание закрывается в журнале, извлечённые файлы больше не нужны
+    if (!m_journal.recordFinished())
+        return false;
+
+    QDir(m_workDir).removeRecursively();
+    return true;
+}
+
 void InstallerEngine::installPackage(const QString &packageName) {
 
     if (!m_packages.contains(packageName)) {
@@ -119,9 +208,32 @@ void InstallerEngine::installPackage(const QString &packageName) {
 
     m_packagesToInstall = m_packages[packageName];
     m_currentPackageName = packageName;
+    // Очередь очищается до остановки, чтобы finished не продолжил цепочку
+    m_statusQueue.clear();
+    if (m_statusProcess->state() == QProcess::Running) {
+        m_statusProcess->kill();
+        m_statusProcess->waitForFinished(ONE_sec);
+    }
+
+    m_stage = Stage::Idle;
+    m_configureDone = false;
+    m_statusChecked = false;
 
     emit installationStarted();
-    emit installationProgress(tr("Начало установки %1").arg(packageName));
+
+    if (getPendingPackage() == packageName) {
+        emit installationProgress(tr("Продолжение прерванной установки %1").
+                                                            arg(packageName));
+    } else {
+        QDir(m_workDir).removeRecursively();
+
+        if (!m_journal.beginJob(QCoreApplication::applicationVersion(),
+                                packageName)) {
+            emit installationError(tr("Не удалось записать журнал установки"));
+            return;
+        }
+        emit installationProgress(tr("Начало установки %1").arg(packageName));
+    }
 
     executeRealInstallation(packageName);
 }
@@ -134,6 +246,11 @@ void InstallerEngine::executeRealInstallation(const QString &packageName) {
 
     emit installationProgress(tr("Извлечение пакетов..."));
 
+    if (!QDir().mkpath(m_workDir)) {
+        emit installationError(tr("Не удалось создать рабочий каталог"));
+        return;
+    }
+
     if (!extractPackagesToTemp()) {
         emit installationError(tr("Ошибка извлечения пакетов"));
         return;
@@ -164,30 +281,87 @@ bool InstallerEngine::extractPackage(const QString &resourcePath,
     if (!resourceFile.exists())
         return false;
 
-    QString tempFilePath = m_tempDir->path() + "/" + filename;
+    QString tempFilePath = m_workDir + "/" + filename;
+
+    // Файл, извлечённый до прерывания, используется повторно,
+    // если его содержимое совпадает с записанным в журнал
+    const auto &extracted = m_journal.state().extractedFiles;
+    if (extracted.contains(filename) && QFile::exists(tempFilePath) &&
+        fileSha256(tempFilePath) == extracted[filename]) {
+        emit installationProgress(tr("Используется извлечённый ранее %1").
+                                                                arg(filename));
+        return true;
+    }
 
     if (QFile::exists(tempFilePath))
         QFile::remove(tempFilePath);
 
-    if (resourceFile.copy(tempFilePath)) {
-        QFile tempFile(tempFilePath);
-        tempFile.setPermissions(QFile::ReadOwner | QFile::WriteOwner |
-                                QFile::ReadUser  | QFile::ReadOther);
-        return true;
-    } else
+    if (!resourceFile.copy(tempFilePath))
         return false;
+
+    QFile tempFile(tempFilePath);
+    tempFile.setPermissions(QFile::ReadOwner | QFile::WriteOwner |
+                            QFile::ReadUser  | QFile::ReadOther);
+
+    const QByteArray hash = fileSha256(tempFilePath);
+    return !hash.isEmpty() && m_journal.recordExtracted(filename, hash);
+}
+
+QByteArray InstallerEngine::fileSha256(const QString &path) const {
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!hash.addData(&file))
+        return QByteArray();
+
+    return hash.result();
 }
 
 void InstallerEngine::startLocalInstallation() {
 
-    emit installationProgress(tr("Установка пакетов..."));
+    // dpkg уже запускался в этом задании: сначала уточняем по базе dpkg,
+    // какие пакеты сконфигурированы, а какие остались распакованными.
+    // Запросы идут по одному асинхронно, установка продолжится после них
+    if (m_journal.state().dpkgStarted && !m_statusChecked) {
+        m_needsConfigure = false;
+        m_statusQueue.clear();
+
+        for (const QString &debFile : qAsConst(m_packagesToInstall)) {
+            if (!m_journal.state().configuredPackages.contains(getDebPackageName(debFile)))
+                m_statusQueue.append(debFile);
+        }
+
+        emit installationProgress(tr("Проверка состояния пакетов..."));
+        queryNextPackageStatus();
+        return;
+    }
+
+    if (m_needsConfigure && !m_configureDone) {
+        emit installationProgress(tr("Завершение настройки прерванной установки..."));
+        m_stage = Stage::Configuring;
+        executeCommand(SystemCommands::configurePending());
+        return;
+    }
 
     QStringList debPaths;
     for (const QString &debFile : qAsConst(m_packagesToInstall)) {
+        if (m_journal.state().configuredPackages.contains(getDebPackageName(debFile)))
+            continue;
+
         QString filename = QFileInfo(debFile).fileName();
-        QString tempFilePath = m_tempDir->path() + "/" + filename;
+        QString tempFilePath = m_workDir + "/" + filename;
         debPaths.append(tempFilePath);
     }
+
+    if (debPaths.isEmpty()) {
+        finishInstallation();
+        return;
+    }
+
+    emit installationProgress(tr("Установка пакетов..."));
     for (const QString &debPath : qAsConst(debPaths)) {
         if (!QFile::exists(debPath)) {
             emit installationProgress(tr("Ошибка: файл пакета не найден"));
@@ -196,11 +370,102 @@ void InstallerEngine::startLocalInstallation() {
         }
     }
 
+    if (!m_journal.recordDpkgStarted()) {
+        emit installationError(tr("Не удалось записать журнал установки"));
+        return;
+    }
+    m_stage = Stage::Installing;
+
     QStringList instCmd = SystemCommands::install();
     instCmd.append(debPaths);
     executeCommand(instCmd);
 }
 
+void InstallerEngine::finishInstallation() {
+
+    m_stage = Stage::Idle;
+
+    // Без записи о завершении следующий запуск предложит продолжить
+    // задание; повтор лишь сверит версии пакетов и завершится сразу
+    if (!m_journal.recordFinished()) {
+        emit installationError(tr("Пакеты установлены, но не удалось записать журнал установки"));
+        return;
+    }
+    QDir(m_workDir).removeRecursively();
+
+    emit installationProgress(tr("Пакет %1 установлен успешно!").
+                                            arg(m_currentPackageName));
+    emit installationFinished(true);
+}
+
+QString InstallerEngine::getDebPackageName(const QString &debFile) const {
+
+    // имя_версия_архитектура.deb -> имя[:архитектура]
+    const QStringList parts = QFileInfo(debFile).completeBaseName().split('_');
+
+    if (parts.size() < 3 || parts[2] == "all")
+        return parts[0];
+
+    return parts[0] + ":" + parts[2];
+}
+
+QString InstallerEngine::getDebVersion(const QString &debFile) const {
+
+    // Эпоха в имени файла закодирована как %3a: git_1%3a2.43.0-..._amd64.deb
+    const QStringList parts = QFileInfo(debFile).completeBaseName().split('_');
+
+    if (parts.size() < 2)
+        return QString();
+
+    return QUrl::fromPercentEncoding(parts[1].toUtf8());
+}
+
+void InstallerEngine::queryNextPackageStatus() {
+
+    if (m_statusQueue.isEmpty()) {
+        m_statusChecked = true;
+        startLocalInstallation();
+        return;
+    }
+
+    QStringList command = SystemCommands::status();
+    command.append(getDebPackageName(m_statusQueue.first()));
+
+    m_statusProcess->start(command[0], command.mid(1));
+}
+
+void InstallerEngine::onStatusQueryFinished(int exitCode) {
+
+    if (m_statusQueue.isEmpty())
+        return;
+
+    const QString debFile = m_statusQueue.takeFirst();
+    const QString debPackage = getDebPackageName(debFile);
+
+    // Ненулевой код - пакета нет в базе dpkg
+    QString output;
+    if (exitCode == 0 && m_statusProcess->exitStatus() == QProcess::NormalExit)
+        output = QString::fromUtf8(m_statusProcess->readAllStandardOutput()).trimmed();
+
+    const QString status = output.section(' ', 0, 0);
+    const QString version = output.section(' ', 1);
+
+    // Установленная старая версия не считается: при обновлении
+    // прерванный dpkg мог так и не дойти до этого пакета
+    if (status == "installed" && version == getDebVersion(debFile)) {
+        if (!m_journal.recordConfigured(debPackage)) {
+            m_statusQueue.clear();
+            emit installationError(tr("Не удалось записать журнал установки"));
+            return;
+        }
+    } else if (status == "unpacked" || status == "half-configured" ||
+               status.startsWith("triggers-")) {
+        m_needsConfigure = true;
+    }
+
+    queryNextPackageStatus();
+}
+
 void InstallerEngine::executeCommand(const QStringList &command) {
 
     if (m_process->state() == QProcess::Running) {
@@ -222,10 +487,21 @@ void InstallerEngine::onProcessFinished(int exitCode) {
     QProcess::ExitStatus exitStatus = m_process->exitStatus();
 
     if (exitStatus == QProcess::NormalExit && exitCode == 0) {
-        emit installationProgress(tr("Пакет %1 установлен успешно!").
-                                                arg(m_currentPackageName));
-        emit installationFinished(true);
+        if (m_stage == Stage::Configuring) {
+            m_configureDone = true;
+            m_statusChecked = false;
+            startLocalInstallation();
+            return;
+        }
+
+        for (const QString &debFile : qAsConst(m_packagesToInstall)) {
+            if (!m_journal.recordConfigured(getDebPackageName(debFile)))
+                emit installationProgress(tr("Не удалось записать журнал установки"));
+        }
+
+        finishInstallation();
     } else {
+        m_stage = Stage::Idle;
         emit installationProgress(tr("Ошибка установки пакета %1").
                                                 arg(m_currentPackageName));
         emit installationFinished(false);
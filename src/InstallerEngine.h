@@ -7,13 +7,17 @@
 #include <QProcess>
 #include <QMap>
 #include <QDir>
-#include <QTemporaryDir>
+#include <QFutureWatcher>
+
+#include "InstallJournal.h"
 
 struct PackageInfo {
     QString displayName;
     QStringList debFiles;
 };
 
+using PackageCatalog = QMap<QString, QStringList>;
+
 class InstallerEngine : public QObject {
     Q_OBJECT
 
@@ -21,6 +25,12 @@ class InstallerEngine : public QObject {
     static constexpr uint16_t TREE_sec = 3'000;
     static constexpr uint16_t FIVE_sec = 5'000;
 
+    enum class Stage {
+        Idle,
+        Configuring,
+        Installing
+    };
+
 public:
     explicit InstallerEngine(QObject *parent = nullptr);
     ~InstallerEngine();
@@ -28,17 +38,27 @@ public:
     void installPackage(const QString &packageName);
 
     bool loadPackages();
+    void loadPackagesAsync();
+    bool isCatalogLoaded() const;
 
     QString getInstallStatus() const;
     QStringList getAvailablePackages() const;
+    QStringList getPackageFiles() const;
+
+    bool hasPendingJob() const;
+    QString getPendingPackage() const;
+    bool discardPendingJob();
 
 signals:
+    void packagesLoaded(bool success);
     void installationStarted();
     void installationProgress(const QString &message);
     void installationFinished(bool success);
     void installationError(const QString &error);
 
 private slots:
+    void onCatalogLoaded();
+    void onStatusQueryFinished(int exitCode);
     void onProcessFinished(int exitCode);
     void onProcessErrorOccurred(QProcess::ProcessError error);
     void readProcessOutput();
@@ -48,22 +68,39 @@ private:
     QString m_currentStatus;
     QStringList m_packagesToInstall;
 
-    QMap<QString, QStringList> m_packages;
+    PackageCatalog m_packages;
+    QFutureWatcher<PackageCatalog> *m_catalogWatcher;
+    bool m_catalogLoaded;
 
     QProcess *m_process;
-    QTemporaryDir *m_tempDir;
+    QProcess *m_statusProcess;
+    QString m_workDir;
+
+    InstallJournal m_journal;
+    Stage m_stage;
+    bool m_configureDone;
+    bool m_statusChecked;
+    bool m_needsConfigure;
+    QStringList m_statusQueue;
 
     void executeRealInstallation(const QString &packageName);
     void startLocalInstallation();
+    void queryNextPackageStatus();
+    void finishInstallation();
     void executeCommand(const QStringList &command);
 
     bool extractPackagesToTemp();
     bool extractPackage(const QString &resourcePath, const QString &filename);
 
+    QString getDebPackageName(const QString &debFile) const;
+    QString getDebVersion(const QString &debFile) const;
+    QByteArray fileSha256(const QString &path) const;
+
     QString getPackageDisplayName(const QString &filename);
     QString findResourceFile(const QString &filename);
 
-    PackageInfo readPackageInfo(const QString &resourcePath);
+    static PackageCatalog scanCatalog();
+    static PackageInfo readPackageInfo(const QString &resourcePath);
 };
 
 #endif // INSTALLERENGINE_H
@@ -0,0 +1,507 @@
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSet>
+#include <QLocale>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QtConcurrent>
+
+#include <functional>
+
+#include <zlib.h>
+#include <lzma.h>
+#include <zstd.h>
+
+#include "LocalRepository.h"
+
+namespace {
+
+constexpr char AR_MAGIC[] = "!<arch>\n";
+constexpr int AR_MAGIC_SIZE = 8;
+constexpr int AR_HEADER_SIZE = 60;
+constexpr int AR_NAME_SIZE = 16;
+constexpr int AR_SIZE_OFFSET = 48;
+constexpr int AR_SIZE_FIELD = 10;
+
+constexpr int TAR_BLOCK = 512;
+constexpr int TAR_NAME_SIZE = 100;
+constexpr int TAR_SIZE_OFFSET = 124;
+constexpr int TAR_SIZE_FIELD = 12;
+constexpr int TAR_MAGIC_OFFSET = 257;
+constexpr int TAR_PREFIX_OFFSET = 345;
+constexpr int TAR_PREFIX_SIZE = 155;
+
+constexpr int INFLATE_CHUNK = 64 * 1024;
+constexpr int GZIP_WINDOW_BITS = 15 + 16;
+constexpr int AUTO_WINDOW_BITS = 15 + 32;
+constexpr int GZIP_MEM_LEVEL = 8;
+
+class HashSink {
+public:
+    HashSink()
+        : m_md5(QCryptographicHash::Md5)
+        , m_sha1(QCryptographicHash::Sha1)
+        , m_sha256(QCryptographicHash::Sha256) {}
+
+    void add(const QByteArray &data) {
+        m_md5.addData(data);
+        m_sha1.addData(data);
+        m_sha256.addData(data);
+        m_size += data.size();
+    }
+
+    void fill(DebEntry &entry) const {
+        entry.size = m_size;
+        entry.md5 = m_md5.result().toHex();
+        entry.sha1 = m_sha1.result().toHex();
+        entry.sha256 = m_sha256.result().toHex();
+    }
+
+private:
+    QCryptographicHash m_md5;
+    QCryptographicHash m_sha1;
+    QCryptographicHash m_sha256;
+    qint64 m_size = 0;
+};
+
+// Потоковое gzip-сжатие индекса Packages
+class GzipStream {
+public:
+    GzipStream() {
+        m_stream.zalloc = Z_NULL;
+        m_stream.zfree = Z_NULL;
+        m_stream.opaque = Z_NULL;
+        m_ok = deflateInit2(&m_stream, Z_BEST_COMPRESSION, Z_DEFLATED,
+                            GZIP_WINDOW_BITS, GZIP_MEM_LEVEL,
+                            Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
+    ~GzipStream() {
+        if (m_ok)
+            deflateEnd(&m_stream);
+    }
+
+    bool isValid() const { return m_ok; }
+
+    QByteArray compress(const QByteArray &data, bool finish) {
+
+        QByteArray out;
+        char buffer[INFLATE_CHUNK];
+
+        m_stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+        m_stream.avail_in = static_cast<uInt>(data.size());
+
+        int result = Z_OK;
+        do {
+            m_stream.next_out = reinterpret_cast<Bytef *>(buffer);
+            m_stream.avail_out = sizeof(buffer);
+            result = deflate(&m_stream, finish ? Z_FINISH : Z_NO_FLUSH);
+            out.append(buffer, static_cast<int>(sizeof(buffer) - m_stream.avail_out));
+        } while (m_stream.avail_out == 0 || (finish && result != Z_STREAM_END));
+
+        return out;
+    }
+
+private:
+    z_stream m_stream {};
+    bool m_ok = false;
+};
+
+QByteArray inflateGzip(const QByteArray &data, QString &error) {
+
+    z_stream stream {};
+    if (inflateInit2(&stream, AUTO_WINDOW_BITS) != Z_OK) {
+        error = QObject::tr("Ошибка инициализации zlib");
+        return QByteArray();
+    }
+
+    QByteArray out;
+    char buffer[INFLATE_CHUNK];
+
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    int result = Z_OK;
+    while (result == Z_OK) {
+        stream.next_out = reinterpret_cast<Bytef *>(buffer);
+        stream.avail_out = sizeof(buffer);
+        result = inflate(&stream, Z_NO_FLUSH);
+        out.append(buffer, static_cast<int>(sizeof(buffer) - stream.avail_out));
+    }
+    inflateEnd(&stream);
+
+    if (result != Z_STREAM_END)
+        error = QObject::tr("Повреждённый gzip-архив");
+
+    return out;
+}
+
+QByteArray inflateXz(const QByteArray &data, QString &error) {
+
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if (lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+        error = QObject::tr("Ошибка инициализации liblzma");
+        return QByteArray();
+    }
+
+    QByteArray out;
+    uint8_t buffer[INFLATE_CHUNK];
+
+    stream.next_in = reinterpret_cast<const uint8_t *>(data.constData());
+    stream.avail_in = static_cast<size_t>(data.size());
+
+    lzma_ret result = LZMA_OK;
+    while (result == LZMA_OK) {
+        stream.next_out = buffer;
+        stream.avail_out = sizeof(buffer);
+        result = lzma_code(&stream, LZMA_FINISH);
+        out.append(reinterpret_cast<const char *>(buffer),
+                   static_cast<int>(sizeof(buffer) - stream.avail_out));
+    }
+    lzma_end(&stream);
+
+    if (result != LZMA_STREAM_END)
+        error = QObject::tr("Повреждённый xz-архив");
+
+    return out;
+}
+
+QByteArray inflateZstd(const QByteArray &data, QString &error) {
+
+    ZSTD_DStream *stream = ZSTD_createDStream();
+    if (stream == nullptr) {
+        error = QObject::tr("Ошибка инициализации libzstd");
+        return QByteArray();
+    }
+
+    QByteArray out;
+    QByteArray buffer(static_cast<int>(ZSTD_DStreamOutSize()), Qt::Uninitialized);
+
+    ZSTD_inBuffer input = { data.constData(), static_cast<size_t>(data.size()), 0 };
+
+    size_t result = 0;
+    ZSTD_outBuffer output = { buffer.data(), static_cast<size_t>(buffer.size()), 0 };
+    do {
+        output.pos = 0;
+        result = ZSTD_decompressStream(stream, &output, &input);
+        if (ZSTD_isError(result))
+            break;
+        out.append(buffer.constData(), static_cast<int>(output.pos));
+    } while (input.pos < input.size || output.pos == output.size);
+    ZSTD_freeDStream(stream);
+
+    if (ZSTD_isError(result) || result != 0)
+        error = QObject::tr("Повреждённый zstd-архив");
+
+    return out;
+}
+
+QByteArray decompressMember(const QByteArray &name, const QByteArray &data,
+                            QString &error) {
+
+    if (name.endsWith(".zst"))
+        return inflateZstd(data, error);
+    if (name.endsWith(".xz"))
+        return inflateXz(data, error);
+    if (name.endsWith(".gz"))
+        return inflateGzip(data, error);
+    if (name.endsWith(".tar"))
+        return data;
+
+    error = QObject::tr("Неподдерживаемое сжатие %1").arg(QString::fromLatin1(name));
+    return QByteArray();
+}
+
+QByteArray findTarEntry(const QByteArray &tar, const QByteArray &entryName) {
+
+    int offset = 0;
+    while (offset + TAR_BLOCK <= tar.size()) {
+        const char *header = tar.constData() + offset;
+        if (header[0] == '\0')
+            break;
+
+        QByteArray name(header, qstrnlen(header, TAR_NAME_SIZE));
+        if (qstrncmp(header + TAR_MAGIC_OFFSET, "ustar", 5) == 0 &&
+            header[TAR_PREFIX_OFFSET] != '\0') {
+            const char *prefix = header + TAR_PREFIX_OFFSET;
+            name = QByteArray(prefix, qstrnlen(prefix, TAR_PREFIX_SIZE)) + '/' + name;
+        }
+        if (name.startsWith("./"))
+            name.remove(0, 2);
+
+        bool ok = false;
+        const qint64 size = QByteArray(header + TAR_SIZE_OFFSET, TAR_SIZE_FIELD).
+                                        replace('\0', ' ').trimmed().toLongLong(&ok, 8);
+        if (!ok)
+            break;
+
+        if (name == entryName)
+            return tar.mid(offset + TAR_BLOCK, static_cast<int>(size));
+
+        offset += TAR_BLOCK + static_cast<int>((size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK);
+    }
+
+    return QByteArray();
+}
+
+} // namespace
+
+LocalRepository::LocalRepository(QObject *parent)
+    : QObject(parent) {}
+
+QString LocalRepository::errorString() const {
+    return m_error;
+}
+
+bool LocalRepository::exportTo(const QString &directory,
+                               const QStringList &debResources) {
+
+    m_error.clear();
+
+    if (!QDir().mkpath(directory)) {
+        m_error = tr("Не удалось создать каталог %1").arg(directory);
+        return false;
+    }
+
+    // Все файлы пишутся во временные и подменяются переименованием только
+    // после успешной записи: клиенты, качающие во время повторного экспорта,
+    // видят либо старый, либо новый индекс, а при ошибке старый остаётся
+    QSaveFile packagesFile(directory + "/Packages");
+    QSaveFile packagesGzFile(directory + "/Packages.gz");
+    if (!packagesFile.open(QIODevice::WriteOnly) ||
+        !packagesGzFile.open(QIODevice::WriteOnly)) {
+        m_error = tr("Не удалось создать индекс Packages");
+        return false;
+    }
+
+    GzipStream gzip;
+    if (!gzip.isValid()) {
+        m_error = tr("Ошибка инициализации zlib");
+        return false;
+    }
+
+    HashSink packagesHash;
+    HashSink packagesGzHash;
+    QSet<QString> architectures;
+
+    // Разбор и копирование .deb идут в пуле потоков, а записи индекса
+    // забираются по порядку по мере готовности
+    const std::function<DebEntry(const QString &)> scan =
+            [directory](const QString &resourcePath) {
+                return scanDeb(resourcePath, directory);
+            };
+    QFuture<DebEntry> future = QtConcurrent::mapped(debResources, scan);
+
+    for (int i = 0; i < debResources.size(); ++i) {
+        const DebEntry entry = future.resultAt(i);
+
+        if (!entry.error.isEmpty()) {
+            future.cancel();
+            future.waitForFinished();
+            m_error = entry.error;
+            return false;
+        }
+
+        QByteArray paragraph = entry.control;
+        paragraph += "\nFilename: ./" + entry.fileName.toUtf8();
+        paragraph += "\nSize: " + QByteArray::number(entry.size);
+        paragraph += "\nMD5sum: " + entry.md5;
+        paragraph += "\nSHA1: " + entry.sha1;
+        paragraph += "\nSHA256: " + entry.sha256;
+        paragraph += "\n\n";
+
+        const QByteArray compressed = gzip.compress(paragraph, false);
+
+        if (packagesFile.write(paragraph) != paragraph.size() ||
+            packagesGzFile.write(compressed) != compressed.size()) {
+            future.cancel();
+            future.waitForFinished();
+            m_error = tr("Ошибка записи индекса Packages");
+            return false;
+        }
+
+        packagesHash.add(paragraph);
+        packagesGzHash.add(compressed);
+        architectures.insert(entry.architecture);
+
+        emit exportProgress(tr("Добавлен %1").arg(entry.fileName));
+    }
+
+    const QByteArray tail = gzip.compress(QByteArray(), true);
+    if (packagesGzFile.write(tail) != tail.size()) {
+        m_error = tr("Ошибка записи индекса Packages");
+        return false;
+    }
+    packagesGzHash.add(tail);
+
+    DebEntry packagesEntry;
+    packagesEntry.fileName = "Packages";
+    packagesHash.fill(packagesEntry);
+
+    DebEntry packagesGzEntry;
+    packagesGzEntry.fileName = "Packages.gz";
+    packagesGzHash.fill(packagesGzEntry);
+
+    QStringList archList = architectures.values();
+    archList.sort();
+
+    // Release подменяется последним, после индексов, на которые ссылается
+    if (!packagesFile.commit() || !packagesGzFile.commit()) {
+        m_error = tr("Ошибка записи индекса Packages");
+        return false;
+    }
+
+    return writeRelease(directory, archList, { packagesEntry, packagesGzEntry });
+}
+
+DebEntry LocalRepository::scanDeb(const QString &resourcePath,
+                                  const QString &directory) {
+
+    DebEntry entry;
+
+    if (!readControl(resourcePath, entry.control, entry.error))
+        return entry;
+
+    // Имя файла по соглашению Debian: пакет_версия-без-эпохи_архитектура.deb
+    const QByteArray package = controlField(entry.control, "Package");
+    QByteArray version = controlField(entry.control, "Version");
+    entry.architecture = QString::fromUtf8(controlField(entry.control, "Architecture"));
+
+    if (package.isEmpty() || version.isEmpty() || entry.architecture.isEmpty()) {
+        entry.error = tr("Неполные данные control в %1").arg(resourcePath);
+        return entry;
+    }
+
+    const int epoch = version.indexOf(':');
+    if (epoch >= 0)
+        version.remove(0, epoch + 1);
+
+    entry.fileName = QString::fromUtf8(package + "_" + version + "_") +
+                                        entry.architecture + ".deb";
+
+    QFile source(resourcePath);
+    QSaveFile target(directory + "/" + entry.fileName);
+    if (!source.open(QIODevice::ReadOnly) ||
+        !target.open(QIODevice::WriteOnly)) {
+        entry.error = tr("Не удалось скопировать %1").arg(resourcePath);
+        return entry;
+    }
+
+    HashSink hash;
+    while (!source.atEnd()) {
+        const QByteArray chunk = source.read(COPY_CHUNK);
+        if (chunk.isEmpty() || target.write(chunk) != chunk.size()) {
+            entry.error = tr("Ошибка записи %1").arg(entry.fileName);
+            return entry;
+        }
+        hash.add(chunk);
+    }
+
+    if (!target.commit()) {
+        entry.error = tr("Ошибка записи %1").arg(entry.fileName);
+        return entry;
+    }
+    hash.fill(entry);
+
+    return entry;
+}
+
+bool LocalRepository::readControl(const QString &resourcePath,
+                                  QByteArray &control, QString &error) {
+
+    QFile file(resourcePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = tr("Не удалось открыть %1").arg(resourcePath);
+        return false;
+    }
+
+    if (file.read(AR_MAGIC_SIZE) != QByteArray(AR_MAGIC, AR_MAGIC_SIZE)) {
+        error = tr("%1 не является .deb архивом").arg(resourcePath);
+        return false;
+    }
+
+    // Пропускаем члены ar до control.tar.*, data.tar.* не читается
+    while (!file.atEnd()) {
+        const QByteArray header = file.read(AR_HEADER_SIZE);
+        if (header.size() != AR_HEADER_SIZE)
+            break;
+
+        QByteArray name = header.left(AR_NAME_SIZE).trimmed();
+        if (name.endsWith('/'))
+            name.chop(1);
+
+        bool ok = false;
+        const qint64 size = header.mid(AR_SIZE_OFFSET, AR_SIZE_FIELD).
+                                                    trimmed().toLongLong(&ok);
+        if (!ok)
+            break;
+
+        if (name.startsWith("control.tar")) {
+            const QByteArray tar = decompressMember(name, file.read(size), error);
+            if (!error.isEmpty()) {
+                error = QStringLiteral("%1: %2").arg(resourcePath, error);
+                return false;
+            }
+
+            control = findTarEntry(tar, "control").trimmed();
+            if (control.isEmpty()) {
+                error = tr("В %1 нет файла control").arg(resourcePath);
+                return false;
+            }
+            return true;
+        }
+
+        file.seek(file.pos() + size + (size & 1));
+    }
+
+    error = tr("В %1 нет control.tar").arg(resourcePath);
+    return false;
+}
+
+QByteArray LocalRepository::controlField(const QByteArray &control,
+                                         const QByteArray &name) {
+
+    const QByteArray prefix = name + ':';
+
+    const QList<QByteArray> lines = control.split('\n');
+    for (const auto &line : lines) {
+        if (line.startsWith(prefix))
+            return line.mid(prefix.size()).trimmed();
+    }
+
+    return QByteArray();
+}
+
+bool LocalRepository::writeRelease(const QString &directory,
+                                   const QStringList &architectures,
+                                   const QList<DebEntry> &indexFiles) {
+
+    QByteArray release;
+    release += "Origin: Regul\n";
+    release += "Label: Regul Installer\n";
+    release += "Date: " + QLocale::c().toString(QDateTime::currentDateTimeUtc(),
+                            "ddd, dd MMM yyyy hh:mm:ss 'UTC'").toUtf8() + "\n";
+    release += "Architectures: " + architectures.join(' ').toUtf8() + "\n";
+
+    const auto appendHashes = [&release, &indexFiles](const QByteArray &title,
+                                                    QByteArray DebEntry::*hash) {
+        release += title + ":\n";
+        for (const auto &file : indexFiles)
+            release += " " + file.*hash + " " + QByteArray::number(file.size) +
+                       " " + file.fileName.toUtf8() + "\n";
+    };
+    appendHashes("MD5Sum", &DebEntry::md5);
+    appendHashes("SHA1", &DebEntry::sha1);
+    appendHashes("SHA256", &DebEntry::sha256);
+
+    QSaveFile file(directory + "/Release");
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(release) != release.size() || !file.commit()) {
+        m_error = tr("Не удалось записать Release");
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef LOCALREPOSITORY_H
+#define LOCALREPOSITORY_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+
+// Сведения об одном .deb, собранные при экспорте
+struct DebEntry {
+    QString fileName;
+    QString architecture;
+    QByteArray control;
+    qint64 size = 0;
+    QByteArray md5;
+    QByteArray sha1;
+    QByteArray sha256;
+    QString error;
+};
+
+// Экспорт встроенного каталога в плоский репозиторий apt:
+// .deb файлы, Packages, Packages.gz и Release с хешами.
+// Пакеты обрабатываются параллельно, индекс пишется потоково
+// по мере готовности записей, без вызова dpkg-scanpackages.
+class LocalRepository : public QObject {
+    Q_OBJECT
+
+    static constexpr qint64 COPY_CHUNK = 256 * 1024;
+
+public:
+    explicit LocalRepository(QObject *parent = nullptr);
+
+    bool exportTo(const QString &directory, const QStringList &debResources);
+
+    QString errorString() const;
+
+signals:
+    void exportProgress(const QString &message);
+
+private:
+    QString m_error;
+
+    static DebEntry scanDeb(const QString &resourcePath, const QString &directory);
+
+    static bool readControl(const QString &resourcePath, QByteArray &control,
+                            QString &error);
+    static QByteArray controlField(const QByteArray &control, const QByteArray &name);
+
+    bool writeRelease(const QString &directory, const QStringList &architectures,
+                      const QList<DebEntry> &indexFiles);
+};
+
+#endif // LOCALREPOSITORY_H
@@ -1,6 +1,8 @@
 #include <QApplication>
 #include <QMessageBox>
 #include <QFontDatabase>
+#include <QWindow>
+#include <QTimer>
 
 #include "MainWindow.h"
 
@@ -8,21 +10,21 @@ MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_centralWidget(new QWidget(this))
     , m_mainLayout(new QVBoxLayout(m_centralWidget))
-    , m_stackedWidget(new QStackedWidget(this))
+    , m_stackedWidget(nullptr)
     , m_welcomeScreen(nullptr)
     , m_selectionScreen(nullptr)
     , m_installationScreen(nullptr)
     , m_statusText(nullptr)
     , m_installerEngine(new InstallerEngine(this))
-    , m_currentScreen(Screen::Welcome) {
+    , m_currentScreen(Screen::Welcome)
+    , m_selectionRequested(false) {
 
     setupUI();
     showScreen(Screen::Welcome);
 
-    if (!m_installerEngine->loadPackages())
-        QMessageBox::critical(this, tr("Ошибка"),
-                              tr("Не удалось загрузить информацию о пакетах"));
-
+    // Каталог читается в фоне, пока показывается приветствие
+    connect(m_installerEngine, &InstallerEngine::packagesLoaded,
+                                    this, &MainWindow::onPackagesLoaded);
     connect(m_installerEngine, &InstallerEngine::installationStarted,
                                     this, &MainWindow::onInstallationStarted);
     connect(m_installerEngine, &InstallerEngine::installationProgress,
@@ -31,10 +33,77 @@ MainWindow::MainWindow(QWidget *parent)
                                     this, &MainWindow::onInstallationFinished);
     connect(m_installerEngine, &InstallerEngine::installationError,
                                     this, &MainWindow::onInstallationError);
+
+    m_installerEngine->loadPackagesAsync();
 }
 
 MainWindow::~MainWindow() {}
 
+void MainWindow::trackFirstFrame(const QElapsedTimer &startupTimer) {
+
+    m_startupTimer = startupTimer;
+
+    winId();
+    windowHandle()->installEventFilter(this);
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
+
+    // Кадр выводится при обработке первого Expose, замер - сразу после неё
+    if (watched == windowHandle() && event->type() == QEvent::Expose &&
+        windowHandle()->isExposed()) {
+        windowHandle()->removeEventFilter(this);
+        QTimer::singleShot(0, this, [this]() {
+            qInfo("Время до первого кадра: %lld мс", m_startupTimer.elapsed());
+        });
+    }
+
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::onPackagesLoaded(bool success) {
+
+    if (m_startupTimer.isValid())
+        qInfo("Каталог пакетов загружен: %lld мс", m_startupTimer.elapsed());
+
+    if (!success) {
+        m_selectionRequested = false;
+        setupWelcomeScreen();
+        QMessageBox::critical(this, tr("Ошибка"),
+                              tr("Не удалось загрузить информацию о пакетах"));
+        return;
+    }
+
+    if (m_selectionRequested) {
+        m_selectionRequested = false;
+        showScreen(Screen::PackageSelection);
+    }
+
+    offerResume();
+}
+
+void MainWindow::offerResume() {
+
+    if (!m_installerEngine->hasPendingJob())
+        return;
+
+    const QString packageName = m_installerEngine->getPendingPackage();
+
+    const auto answer = QMessageBox::question(this, tr("Прерванная установка"),
+                    tr("Установка пакета %1 была прервана. Продолжить?").
+                                                            arg(packageName));
+    if (answer != QMessageBox::Yes) {
+        if (!m_installerEngine->discardPendingJob())
+            QMessageBox::warning(this, tr("Ошибка"),
+                                 tr("Не удалось записать журнал установки"));
+        return;
+    }
+
+    showScreen(Screen::PackageSelection);
+    m_packageComboBox->setCurrentText(packageName);
+    showScreen(Screen::Installation);
+}
+
 void MainWindow::setupUI() {
 
     setWindowTitle(tr("Установщик пакетов"));
@@ -85,7 +154,7 @@ void MainWindow::showScreen(Screen screen) {
 
 void MainWindow::setupWelcomeScreen() {
 
-    if (m_mainLayout->indexOf(m_stackedWidget) != -1) {
+    if (m_stackedWidget != nullptr && m_mainLayout->indexOf(m_stackedWidget) != -1) {
         m_stackedWidget->setVisible(false);
         m_frameLabel->setVisible(true);
         m_mainLayout->replaceWidget(m_stackedWidget, m_frameLabel);
@@ -103,6 +172,9 @@ void MainWindow::setupWelcomeScreen() {
 
 void MainWindow::setupPackageSelectionScreen() {
 
+    if (m_stackedWidget == nullptr)
+        m_stackedWidget = new QStackedWidget(this);
+
     if (m_selectionScreen == nullptr) {
         m_selectionScreen = new QWidget();
         QVBoxLayout *layout = new QVBoxLayout(m_selectionScreen);
@@ -178,6 +250,12 @@ void MainWindow::onNextClicked() {
 
     switch (m_currentScreen) {
         case Screen::Welcome:
+            if (!m_installerEngine->isCatalogLoaded()) {
+                m_selectionRequested = true;
+                m_nextButton->setEnabled(false);
+                m_nextButton->setText(tr("Загрузка..."));
+                break;
+            }
             showScreen(Screen::PackageSelection);
             break;
         case Screen::PackageSelection:
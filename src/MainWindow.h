@@ -10,6 +10,7 @@
 #include <QPushButton>
 #include <QPlainTextEdit>
 #include <QProgressBar>
+#include <QElapsedTimer>
 
 #include "InstallerEngine.h"
 
@@ -37,6 +38,11 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    void trackFirstFrame(const QElapsedTimer &startupTimer);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private slots:
     void onNextClicked();
     void onBackClicked();
@@ -44,9 +50,11 @@ private slots:
     void onInstallationProgress(const QString &message);
     void onInstallationFinished(bool success);
     void onInstallationError(const QString &error);
+    void onPackagesLoaded(bool success);
 
 private:
     void setupUI();
+    void offerResume();
     void showScreen(Screen screen);
     void setupWelcomeScreen();
     void setupPackageSelectionScreen();
@@ -72,6 +80,9 @@ private:
     InstallerEngine *m_installerEngine;
 
     Screen m_currentScreen;
+
+    QElapsedTimer m_startupTimer;
+    bool m_selectionRequested;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,149 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QUrl>
+#include <QHostAddress>
+
+#include "RepositoryServer.h"
+
+RepositoryServer::RepositoryServer(const QString &rootDir, QObject *parent)
+    : QObject(parent)
+    , m_rootDir(QDir(rootDir).canonicalPath())
+    , m_server(new QTcpServer(this)) {
+
+    connect(m_server, &QTcpServer::newConnection,
+                                    this, &RepositoryServer::onNewConnection);
+}
+
+bool RepositoryServer::listen(quint16 port) {
+    return m_server->listen(QHostAddress::LocalHost, port);
+}
+
+QString RepositoryServer::errorString() const {
+    return m_server->errorString();
+}
+
+quint16 RepositoryServer::serverPort() const {
+    return m_server->serverPort();
+}
+
+void RepositoryServer::onNewConnection() {
+
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead,
+                                    this, &RepositoryServer::onReadyRead);
+        connect(socket, &QTcpSocket::bytesWritten,
+                                    this, &RepositoryServer::onBytesWritten);
+        connect(socket, &QTcpSocket::disconnected,
+                                    socket, &QTcpSocket::deleteLater);
+    }
+}
+
+void RepositoryServer::onReadyRead() {
+
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (socket == nullptr || socket->property("handled").toBool())
+        return;
+
+    if (!socket->canReadLine()) {
+        if (socket->bytesAvailable() > MAX_REQUEST_SIZE)
+            sendError(socket, 400, "Bad Request");
+        return;
+    }
+
+    // Нужна только строка запроса, заголовки клиента не используются
+    const QList<QByteArray> request = socket->readLine().trimmed().split(' ');
+    socket->setProperty("handled", true);
+
+    if (request.size() != 3) {
+        sendError(socket, 400, "Bad Request");
+        return;
+    }
+
+    if (request[0] != "GET" && request[0] != "HEAD") {
+        sendError(socket, 405, "Method Not Allowed");
+        return;
+    }
+
+    sendResponse(socket, request[0], request[1]);
+}
+
+QString RepositoryServer::resolvePath(const QByteArray &path) const {
+
+    const QString decoded = QUrl::fromPercentEncoding(path.split('?').first());
+    const QString filePath = QDir::cleanPath(m_rootDir + "/" + decoded);
+
+    // Запросы за пределы каталога репозитория отклоняются
+    if (!filePath.startsWith(m_rootDir + "/"))
+        return QString();
+
+    return filePath;
+}
+
+void RepositoryServer::sendResponse(QTcpSocket *socket, const QByteArray &method,
+                                    const QByteArray &path) {
+
+    const QString filePath = resolvePath(path);
+    if (filePath.isEmpty() || !QFileInfo(filePath).isFile()) {
+        sendError(socket, 404, "Not Found");
+        return;
+    }
+
+    QFile *file = new QFile(filePath, socket);
+    if (!file->open(QIODevice::ReadOnly)) {
+        sendError(socket, 403, "Forbidden");
+        return;
+    }
+
+    QByteArray header = "HTTP/1.1 200 OK\r\n";
+    header += "Content-Type: application/octet-stream\r\n";
+    header += "Content-Length: " + QByteArray::number(file->size()) + "\r\n";
+    header += "Connection: close\r\n\r\n";
+    socket->write(header);
+
+    if (method == "HEAD") {
+        file->close();
+        socket->disconnectFromHost();
+        return;
+    }
+
+    sendNextChunk(socket);
+}
+
+void RepositoryServer::onBytesWritten() {
+
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (socket != nullptr)
+        sendNextChunk(socket);
+}
+
+void RepositoryServer::sendNextChunk(QTcpSocket *socket) {
+
+    QFile *file = socket->findChild<QFile *>();
+    if (file == nullptr || !file->isOpen())
+        return;
+
+    // Следующая порция читается, только когда предыдущая почти ушла
+    if (socket->bytesToWrite() > SEND_CHUNK)
+        return;
+
+    if (file->atEnd()) {
+        file->close();
+        socket->disconnectFromHost();
+        return;
+    }
+
+    socket->write(file->read(SEND_CHUNK));
+}
+
+void RepositoryServer::sendError(QTcpSocket *socket, int code,
+                                 const QByteArray &reason) {
+
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(code) + " " + reason + "\r\n";
+    response += "Content-Length: 0\r\n";
+    response += "Connection: close\r\n\r\n";
+
+    socket->setProperty("handled", true);
+    socket->write(response);
+    socket->disconnectFromHost();
+}
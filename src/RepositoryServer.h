@@ -0,0 +1,43 @@
+#ifndef REPOSITORYSERVER_H
+#define REPOSITORYSERVER_H
+
+#include <QObject>
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+// Минимальный HTTP-сервер (GET/HEAD) на loopback для раздачи
+// экспортированного репозитория. Каждое соединение обслуживается
+// асинхронно, файлы отдаются частями, поэтому несколько клиентов
+// apt могут скачивать пакеты одновременно.
+class RepositoryServer : public QObject {
+    Q_OBJECT
+
+    static constexpr qint64 SEND_CHUNK = 256 * 1024;
+    static constexpr int MAX_REQUEST_SIZE = 8 * 1024;
+
+public:
+    explicit RepositoryServer(const QString &rootDir, QObject *parent = nullptr);
+
+    bool listen(quint16 port);
+
+    QString errorString() const;
+    quint16 serverPort() const;
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onBytesWritten();
+
+private:
+    QString m_rootDir;
+    QTcpServer *m_server;
+
+    void sendResponse(QTcpSocket *socket, const QByteArray &method,
+                      const QByteArray &path);
+    void sendNextChunk(QTcpSocket *socket);
+    void sendError(QTcpSocket *socket, int code, const QByteArray &reason);
+    QString resolvePath(const QByteArray &path) const;
+};
+
+#endif // REPOSITORYSERVER_H
@@ -9,6 +9,8 @@ class SystemCommands {
     static constexpr std::array<const char*, 3> INSTALL_CMD = {"pkexec", "dpkg", "-i"};
     static constexpr std::array<const char*, 3> REMOVE_CMD = {"pkexec", "dpkg", "-r"};
     static constexpr std::array<const char*, 3> UPDATE_CMD = {"pkexec", "apt", "update"};
+    static constexpr std::array<const char*, 4> CONFIGURE_CMD = {"pkexec", "dpkg", "--configure", "-a"};
+    static constexpr std::array<const char*, 3> STATUS_CMD = {"dpkg-query", "-W", "-f=${db:Status-Status} ${Version}"};
 
 public:
 
@@ -16,6 +18,16 @@ public:
         return QStringList(INSTALL_CMD.begin(), INSTALL_CMD.end());
     }
 
+    // Доконфигурирование пакетов, распакованных прерванным dpkg
+    static auto configurePending() {
+        return QStringList(CONFIGURE_CMD.begin(), CONFIGURE_CMD.end());
+    }
+
+    // Состояние и версия пакета в базе dpkg: "installed 1:2.43.0-1ubuntu7.3"
+    static auto status() {
+        return QStringList(STATUS_CMD.begin(), STATUS_CMD.end());
+    }
+
     // Пример команды удаления (не используется в задании)
     static auto remove() {
         return QStringList(REMOVE_CMD.begin(), REMOVE_CMD.end());
@@ -1,19 +1,115 @@
 #include <QApplication>
 #include <QTranslator>
 #include <QLocale>
+#include <QCommandLineParser>
+#include <QScopedPointer>
+#include <QElapsedTimer>
 
 #include "MainWindow.h"
+#include "InstallerEngine.h"
+#include "LocalRepository.h"
+#include "RepositoryServer.h"
+
+static constexpr const char *EXPORT_REPO_OPT = "export-repo";
+static constexpr const char *SERVE_REPO_OPT = "serve-repo";
+
+// Режим репозитория работает без графики, поэтому решаем до создания приложения
+static bool isRepositoryMode(int argc, char *argv[]) {
+
+    const QByteArray exportOption = QByteArray("--") + EXPORT_REPO_OPT;
+    const QByteArray serveOption = QByteArray("--") + SERVE_REPO_OPT;
+
+    for (int i = 1; i < argc; ++i) {
+        const QByteArray arg(argv[i]);
+        if (arg.startsWith(exportOption) || arg.startsWith(serveOption))
+            return true;
+    }
+    return false;
+}
+
+static int runRepositoryMode(const QCommandLineParser &parser) {
+
+    // Раздаётся только каталог, выгруженный в этом же запуске
+    if (!parser.isSet(EXPORT_REPO_OPT)) {
+        qCritical("--%s требует --%s <каталог>", SERVE_REPO_OPT, EXPORT_REPO_OPT);
+        return 1;
+    }
+
+    InstallerEngine engine;
+    if (!engine.loadPackages()) {
+        qCritical("Не удалось загрузить информацию о пакетах");
+        return 1;
+    }
+
+    const QString directory = parser.value(EXPORT_REPO_OPT);
+
+    LocalRepository repository;
+    QObject::connect(&repository, &LocalRepository::exportProgress,
+                     [](const QString &message) { qInfo("%s", qUtf8Printable(message)); });
+
+    if (!repository.exportTo(directory, engine.getPackageFiles())) {
+        qCritical("%s", qUtf8Printable(repository.errorString()));
+        return 1;
+    }
+
+    qInfo("Репозиторий: deb [trusted=yes] file:%s ./",
+                        qUtf8Printable(QDir(directory).absolutePath()));
+
+    if (!parser.isSet(SERVE_REPO_OPT))
+        return 0;
+
+    bool ok = false;
+    const quint16 port = parser.value(SERVE_REPO_OPT).toUShort(&ok);
+    if (!ok) {
+        qCritical("Некорректный порт: %s", qUtf8Printable(parser.value(SERVE_REPO_OPT)));
+        return 1;
+    }
+
+    RepositoryServer server(directory);
+    if (!server.listen(port)) {
+        qCritical("%s", qUtf8Printable(server.errorString()));
+        return 1;
+    }
+
+    qInfo("Репозиторий: deb [trusted=yes] http://127.0.0.1:%u/ ./", server.serverPort());
+
+    return QCoreApplication::exec();
+}
 
 int main(int argc, char *argv[])
 {
-    QApplication app(argc, argv);
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+
+    const bool repositoryMode = isRepositoryMode(argc, argv);
+
+    QScopedPointer<QCoreApplication> app(repositoryMode ?
+                                         new QCoreApplication(argc, argv) :
+                                         new QApplication(argc, argv));
+
+    app->setApplicationName("Regul_Installer");
+    app->setApplicationVersion("1.0.0");
+    app->setOrganizationName("Regul");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOption({EXPORT_REPO_OPT,
+                      QCoreApplication::translate("main",
+                            "Экспортировать встроенные пакеты как репозиторий apt в <каталог>."),
+                      QCoreApplication::translate("main", "каталог")});
+    parser.addOption({SERVE_REPO_OPT,
+                      QCoreApplication::translate("main",
+                            "Раздавать экспортированный репозиторий по HTTP на 127.0.0.1:<порт>."),
+                      QCoreApplication::translate("main", "порт")});
+    parser.process(*app);
 
-    app.setApplicationName("Regul_Installer");
-    app.setApplicationVersion("1.0.0");
-    app.setOrganizationName("Regul");
+    if (repositoryMode)
+        return runRepositoryMode(parser);
 
     MainWindow window;
+    window.trackFirstFrame(startupTimer);
     window.show();
 
-    return app.exec();
+    return app->exec();
 }